@@ -0,0 +1,20 @@
+@echo off
+REM
+REM This batch creates a class data sharing archive of the SecSigner classes by
+REM running the verification of some test files located at D:\SecSigner\test.
+REM The JavaVM writes the classes it has loaded to D:\SecSigner\SecSigner.jsa
+REM when SecSigner_UnloadJavaVM() is called.
+REM
+REM TestCallSecSignerDLL.exe uses SecSigner.jsa from the installation path if its
+REM 8th parameter is 1, which shortens the start of the JavaVM in SecSigner_LoadJavaVM().
+REM Create the archive again after updating the Java Runtime or SecSigner.
+REM
+REM Params: see TestSecSigner_Api_VerifyData.bat
+REM
+echo Info: Java Runtime version 13 or newer is required for the archive, currently used:
+java -fullversion
+if exist D:\SecSigner\SecSigner.jsa del D:\SecSigner\SecSigner.jsa
+set JAVA_TOOL_OPTIONS=-XX:ArchiveClassesAtExit=D:\SecSigner\SecSigner.jsa
+TestCallSecSignerDLL.exe 3 D:\SecSigner\CallSecSignerDLL.dll secsigner.properties D:\SecSigner\ 1024 D:\SecSigner\test
+set JAVA_TOOL_OPTIONS=
+pause
@@ -16,6 +16,9 @@ REM 3: Name of configuration file, normally "secsigner.properties"
 REM 4: Name of the installation path, normally "D:\SecSigner}"
 REM 5: Mamimum memory in MB for the Java VM
 REM 6: Name of the directory where some test documents and signatures are taken from
+REM 7: Optional additional options for the Java VM in quotes, e.g. "-Xms512m -XX:+UseG1GC"
+REM 8: Optional 1 to start the Java VM from the class data sharing archive SecSigner.jsa
+REM    in the installation path, see TestSecSigner_Api_CreateClassDataArchive.bat. Pass "" as 7 if no options are needed.
 REM
 echo Info: Oracle Java Runtime version 7 is required, currently used:
 java -fullversion
@@ -7,8 +7,10 @@
 #include <windows.h>
 #include <io.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <share.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -187,15 +189,255 @@ GET_CARD_READER_FIRMWARE_VERSION_TYPE GET_CARD_READER_FIRMWARE_VERSION;
 
 // buffer length for returned signature
 const int SIG_BUF_LEN = 8000; // enough for detached CMS (PKCS#7) signatures
+const int TIMESTAMP_BUF_LEN = 8000; // enough for a time stamp response
+const int RECIPIENT_BUF_LEN = 1000; // enough for one recipient info of an encrypted PKCS#7 object
 const int CERT_BUF_LEN = 5000; // should always be enough
 const int CONTENT_BUF_LEN = 1500000;
 const int VERSION_BUF_LEN = 1000;
+const int ERROR_MSG_BUF_LEN = 5000;
+const int JAVA_TOOL_OPTIONS_LEN = 4000;
 const int ERS_BUF_LEN = 1000000;
 
+// class data sharing archive of the SecSigner classes in the installation path,
+// created by TestSecSigner_Api_CreateClassDataArchive.bat
+const char * CLASS_DATA_ARCHIVE_NAME = "SecSigner.jsa";
+
 // handle to SecSigner DLL
 HINSTANCE hSecSignerDLL;
 
 
+/**
+ * Gets the length of an optional buffer.
+ *
+ * @param byteArray buffer or NULL
+ * @return length of the buffer or 0 if there is none
+ */
+int getByteArrayLen(BYTEARRAY *byteArray)
+{
+	if ((NULL == byteArray) || (NULL == byteArray->data))
+	{
+		return 0;
+	}
+
+	return byteArray->dataLen;
+}
+
+/**
+ * Estimates the length of the buffer for the signature of a document.
+ *
+ * SIG_BUF_LEN is an allowance for the signer's certificate and the signed attributes.
+ * All signature formats except a detached PKCS#7 signature also embed the signed
+ * document, an old signature the new SignerInfo is added to and the images of the
+ * PDF annotation. A long certificate chain, an embedded OCSP response or time stamp
+ * can exceed the estimate, SecSigner then returns BUFFER_TOO_SHORT.
+ *
+ * @param document document to be signed, dataToBeSignedLen and signatureFormatType have to be set
+ * @return estimated buffer length for the returned signature, may exceed INT_MAX
+ */
+size_t getSignatureBufLen(DOCUMENT *document)
+{
+	// summed as size_t, a document near INT_MAX bytes would overflow int
+	size_t bufLen = (size_t)SIG_BUF_LEN + (size_t)document->oldSignatureLen;
+
+	if (SIGNATUREFORMATTYPE_PKCS7 != document->signatureFormatType)
+	{
+		bufLen += (size_t)document->dataToBeSignedLen;
+	}
+
+	if (NULL != document->pdfAnnotation)
+	{
+		bufLen += (size_t)getByteArrayLen(document->pdfAnnotation->pdfSignatureSignedImage);
+		bufLen += (size_t)getByteArrayLen(document->pdfAnnotation->pdfSignatureSignerIcon);
+		bufLen += (size_t)getByteArrayLen(document->pdfAnnotation->pdfSigBackgroundImage);
+	}
+
+	return bufLen;
+}
+
+/**
+ * Estimates the length of the buffer for data encrypted by SecSigner
+ * (encrypted signature or encrypted document), allowing RECIPIENT_BUF_LEN
+ * for each encryption certificate. Certificates chosen in the encryption dialog
+ * are estimated as one.
+ *
+ * @param plainLen length of the data to be encrypted
+ * @param cipherCertCount number of encryption certificates or 0 if the encryption dialog is offered
+ * @return estimated buffer length for the returned encrypted data, may exceed INT_MAX
+ */
+size_t getEncryptedBufLen(size_t plainLen, int cipherCertCount)
+{
+	size_t recipientCount = (cipherCertCount > 0) ? (size_t)cipherCertCount : 1;
+
+	return plainLen + SIG_BUF_LEN + recipientCount * RECIPIENT_BUF_LEN;
+}
+
+// One contiguous buffer which all result buffers of a batch are taken from.
+// It is kept for the next batch and only grows if that batch needs more.
+typedef struct
+{
+	unsigned char* data;                // buffer
+	size_t size;                        // allocated length of the buffer
+	size_t used;                        // length already handed out to documents
+} BATCHBUFFER;
+
+/**
+ * Prepares a batch buffer for the next batch. All buffers taken from it before
+ * become invalid.
+ *
+ * @param batchBuffer batch buffer
+ * @param size length needed for all result buffers of the batch
+ * @return OK or NO_MEMORY
+ */
+int reserveBatchBuffer(BATCHBUFFER *batchBuffer, size_t size)
+{
+	if (size > batchBuffer->size)
+	{
+		unsigned char *data = (unsigned char*)realloc(batchBuffer->data, size);
+		if (NULL == data)
+		{
+			return NO_MEMORY;
+		}
+
+		batchBuffer->data = data;
+		batchBuffer->size = size;
+	}
+
+	batchBuffer->used = 0;
+	return OK;
+}
+
+/**
+ * Takes a result buffer from a batch buffer.
+ *
+ * @param batchBuffer batch buffer prepared by reserveBatchBuffer()
+ * @param len length of the result buffer
+ * @return result buffer or NULL if len is 0 or the batch buffer is exhausted
+ */
+unsigned char* takeFromBatchBuffer(BATCHBUFFER *batchBuffer, int len)
+{
+	if ((len <= 0) || ((size_t)len > batchBuffer->size - batchBuffer->used))
+	{
+		return NULL;
+	}
+
+	unsigned char *buffer = &batchBuffer->data[batchBuffer->used];
+	batchBuffer->used += len;
+	return buffer;
+}
+
+/**
+ * Releases a batch buffer.
+ *
+ * @param batchBuffer batch buffer
+ */
+void freeBatchBuffer(BATCHBUFFER *batchBuffer)
+{
+	free(batchBuffer->data);
+	batchBuffer->data = NULL;
+	batchBuffer->size = 0;
+	batchBuffer->used = 0;
+}
+
+// A file mapped read-only into memory. SecSigner reads documents directly from
+// the mapping, so they are neither copied into a buffer nor limited by its size.
+typedef struct
+{
+	unsigned char* data;                // mapped file content, not NULL for an empty file either
+	int dataLen;                        // file length
+	HANDLE file;                        // handle of the opened file
+	HANDLE mapping;                     // handle of the file mapping
+} MAPPEDFILE;
+
+/**
+ * Releases a file mapped by mapFile().
+ *
+ * @param mappedFile mapped file
+ */
+void unmapFile(MAPPEDFILE *mappedFile)
+{
+	// an empty file has no mapping, its data is not a view
+	if (NULL != mappedFile->mapping)
+	{
+		if (NULL != mappedFile->data)
+		{
+			UnmapViewOfFile(mappedFile->data);
+		}
+
+		CloseHandle(mappedFile->mapping);
+		mappedFile->mapping = NULL;
+	}
+
+	mappedFile->data = NULL;
+
+	if (INVALID_HANDLE_VALUE != mappedFile->file)
+	{
+		CloseHandle(mappedFile->file);
+		mappedFile->file = INVALID_HANDLE_VALUE;
+	}
+
+	mappedFile->dataLen = 0;
+}
+
+/**
+ * Maps a file read-only into memory.
+ *
+ * @param fileName name and path of the file
+ * @param mappedFile receives the mapped content, release it with unmapFile()
+ * @return 0 or -1 if the file cannot be mapped or is too large for a DOCUMENT, the caller reports it
+ */
+int mapFile(char * fileName, MAPPEDFILE *mappedFile)
+{
+	mappedFile->data = NULL;
+	mappedFile->dataLen = 0;
+	mappedFile->mapping = NULL;
+	mappedFile->file = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (INVALID_HANDLE_VALUE == mappedFile->file)
+	{
+		return -1;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mappedFile->file, &fileSize))
+	{
+		unmapFile(mappedFile);
+		return -1;
+	}
+
+	// the lengths in DOCUMENT are int
+	if (fileSize.QuadPart > INT_MAX)
+	{
+		unmapFile(mappedFile);
+		return -1;
+	}
+
+	// An empty file cannot be mapped. A NULL buffer in DOCUMENT means the content
+	// is missing, so an empty file still gets a valid zero-length buffer.
+	if (0 == fileSize.QuadPart)
+	{
+		static unsigned char emptyFileContent[1];
+		mappedFile->data = emptyFileContent;
+		return 0;
+	}
+
+	mappedFile->mapping = CreateFileMapping(mappedFile->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == mappedFile->mapping)
+	{
+		unmapFile(mappedFile);
+		return -1;
+	}
+
+	mappedFile->data = (unsigned char*)MapViewOfFile(mappedFile->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (NULL == mappedFile->data)
+	{
+		unmapFile(mappedFile);
+		return -1;
+	}
+
+	mappedFile->dataLen = (int)fileSize.QuadPart;
+	return 0;
+}
+
+
 /**
  * Loads the DLL which calls SecSigner. Function pointers are set here.
  * @param secSignerDllName name and path of the SecSigner DLL
@@ -353,6 +595,87 @@ int loadSecSignerDLL(char * secSignerDllName)
 	return 0;
 }
 
+/**
+ * Prints the error message of the last failed SecSigner call to stderr.
+ * It has to be called right after the failed call, because the next failing
+ * call replaces the message.
+ */
+void printErrorMessage()
+{
+	char errorMsg[ERROR_MSG_BUF_LEN];
+	errorMsg[0] = 0; // empty string
+	if (0 == (*GET_ERRORMESSAGE)(errorMsg, ERROR_MSG_BUF_LEN))
+	{
+		fprintf(stderr, "Message: %s\n", errorMsg);
+	}
+}
+
+/**
+ * Gets the current value of a monotonic clock.
+ *
+ * @return time in nanoseconds
+ */
+LONGLONG getNanoTime()
+{
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	// split the conversion so the multiplication does not overflow
+	return (counter.QuadPart / frequency.QuadPart) * 1000000000
+		+ (counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+}
+
+/**
+ * Prints the wall-clock duration of a SecSigner call. A modal call includes the
+ * time the user spends in SecSigner dialogs, e.g. entering the PIN.
+ *
+ * @param operation name of the operation
+ * @param documentCount number of documents of the call
+ * @param elapsedNanos duration of the call in nanoseconds
+ */
+void printCallDuration(char * operation, int documentCount, LONGLONG elapsedNanos)
+{
+	LONGLONG elapsedMicros = elapsedNanos / 1000;
+	printf("%s call duration for %d documents: %lld.%03lld ms\n", operation, documentCount,
+		elapsedMicros / 1000, elapsedMicros % 1000);
+}
+
+/**
+ * Adds an option for the JavaVM which SecSigner_LoadJavaVM() creates.
+ *
+ * The JavaVM reads additional options from the environment variable JAVA_TOOL_OPTIONS
+ * when it is created, so this has to be called before SecSigner_LoadJavaVM().
+ *
+ * @param option JavaVM option, e.g. -Xss1m
+ * @return 0 or -1 if JAVA_TOOL_OPTIONS would become too long
+ */
+int addJavaToolOption(char * option)
+{
+	char javaToolOptions[JAVA_TOOL_OPTIONS_LEN];
+	DWORD len = GetEnvironmentVariable("JAVA_TOOL_OPTIONS", javaToolOptions, JAVA_TOOL_OPTIONS_LEN);
+	if (0 == len)
+	{
+		javaToolOptions[0] = 0; // not set yet
+	}
+
+	if (len + 1 + strlen(option) >= (size_t)JAVA_TOOL_OPTIONS_LEN)
+	{
+		fprintf(stderr, "Error: JavaVM option %s does not fit into JAVA_TOOL_OPTIONS.\n", option);
+		return -1;
+	}
+
+	if (len > 0)
+	{
+		strcat_s(javaToolOptions, JAVA_TOOL_OPTIONS_LEN, " ");
+	}
+	strcat_s(javaToolOptions, JAVA_TOOL_OPTIONS_LEN, option);
+
+	SetEnvironmentVariable("JAVA_TOOL_OPTIONS", javaToolOptions);
+	return 0;
+}
+
 /**
  * Loads the JavaVM, checks whether all SecSigner JARs are found in the class path
  * and loads some SecSigner classes.
@@ -368,12 +691,7 @@ int loadJavaVirtualMachine(char * secSignerInstallPath, int maxMem)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner loadJavaVM failed.\n");
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s", errorMsg);
-		}
+		printErrorMessage();
 
 		return -1;
 	}
@@ -396,12 +714,7 @@ int initSecSigner(char * secSignerPropertyName, char * secSignerInstallPath)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner init failed.\n");
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s", errorMsg);
-		}
+		printErrorMessage();
 
 		return -1;
 	}
@@ -424,12 +737,7 @@ int closeSecSigner()
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner close failed.\n");
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s", errorMsg);
-		}
+		printErrorMessage();
 
 		return -1;
 	}
@@ -449,12 +757,7 @@ int unloadJavaVirtualMachine()
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner unloadJavaVM failed.\n");
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s", errorMsg);
-		}
+		printErrorMessage();
 
 		return -1;
 	}
@@ -478,12 +781,7 @@ int initSmartCard(BYTEARRAY *sigCert, BYTEARRAY *authCert, BYTEARRAY *cipherCert
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.initSmartCard with certificate return failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -515,12 +813,7 @@ int signDocs(DOCUMENT documents[], int documentCount,
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.signDocuments failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -548,12 +841,7 @@ int verifyDocs(DOCUMENT documents[], int documentCount)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner verifyDocuments failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -579,12 +867,136 @@ int encryptDocs(DOCUMENT documents[], int documentCount, BYTEARRAY cipherCert[],
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.encryptDataOnly failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
+		printErrorMessage();
+	}
+
+	return ret;
+}
+
+// Requests to stop a sequence of SecSigner calls from another thread. A SecSigner
+// call which is already running cannot be interrupted, so the sequence stops
+// before its next call.
+typedef struct
+{
+	volatile long canceled;             // not 0 if cancellation has been requested
+} CANCELTOKEN;
+
+/**
+ * Requests cancellation. Can be called from any thread.
+ *
+ * @param cancelToken cancellation token
+ */
+void cancelOperation(CANCELTOKEN *cancelToken)
+{
+	InterlockedExchange(&cancelToken->canceled, 1);
+}
+
+/**
+ * Checks whether cancellation has been requested.
+ *
+ * @param cancelToken cancellation token or NULL
+ * @return true if cancellation has been requested
+ */
+bool isCanceled(CANCELTOKEN *cancelToken)
+{
+	return (NULL != cancelToken) && (0 != cancelToken->canceled);
+}
+
+// canceled by Ctrl-C, so the test programme stops after the current batch and
+// closes SecSigner instead of being killed
+CANCELTOKEN consoleCancelToken = { 0 };
+
+/**
+ * Console control handler, cancels the test programme at the next batch.
+ *
+ * @param ctrlType type of the control signal
+ * @return TRUE if the signal has been handled
+ */
+BOOL WINAPI consoleCtrlHandler(DWORD ctrlType)
+{
+	if ((CTRL_C_EVENT == ctrlType) || (CTRL_BREAK_EVENT == ctrlType))
+	{
+		printf("Canceling after the current batch\n");
+		cancelOperation(&consoleCancelToken);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Signs any number of documents. If there are more documents than
+ * SecSigner_GetSignatureLimit() allows, they are signed in chunks of that size
+ * one after another. The signatures are returned in the document structs as
+ * with signDocs().
+ *
+ * @param document documents to be signed
+ * @param document length of the document array
+ * @param cipherCerts encrypt the signed PKCS#7 object with these certificates 
+ * @param cipherCertCount number of encryption certificates or just offer encryption dialog if cipherCertCount = 0
+ * @param signingKeyAndOrCertData a signing key (PKCS#8 or PKCS#12) and/or corresponding or desired certificate
+ * @param signingKeyAndOrCertDataCount must be 1 (key) or 2 (key and certificate)
+ * @param cancelToken optional: no further chunk is started after this has been canceled
+ * @param signedCount optional: receives the number of documents signed before an error or cancellation
+ * @return OK or CANCELED or an error of SecSigner_GetSignatureLimit() or signDocs()
+ */
+int signDocsInChunks(DOCUMENT documents[], int documentCount,
+					 BYTEARRAY cipherCerts[], int cipherCertCount,
+					 BYTEARRAY signingKeyAndOrCertData[], int signingKeyAndOrCertDataCount,
+					 CANCELTOKEN *cancelToken, int *signedCount)
+{
+	if (NULL != signedCount)
+	{
+		*signedCount = 0;
+	}
+
+	int limit = (*GET_SIGNATURE_LIMIT)();
+	if (limit < 0)
+	{
+        fprintf(stderr, "Error: SecSigner.getSignatureLimit() failed. ret=%d\n", limit);
+		printErrorMessage();
+		return limit;
+	}
+
+	if ((0 == limit) || (limit > documentCount))
+	{
+		limit = documentCount;
+	}
+
+	int ret = OK;
+	int offset = 0;
+	while (offset < documentCount)
+	{
+		if (isCanceled(cancelToken))
+		{
+			ret = CANCELED;
+			break;
+		}
+
+		int chunkCount = documentCount - offset;
+		if (chunkCount > limit)
+		{
+			chunkCount = limit;
+		}
+
+		if (chunkCount < documentCount)
+		{
+			printf ("Signing documents %d to %d of %d\n", offset + 1, offset + chunkCount, documentCount);
+		}
+
+		ret = signDocs(&documents[offset], chunkCount, cipherCerts, cipherCertCount,
+			signingKeyAndOrCertData, signingKeyAndOrCertDataCount);
+		if (OK != ret)
 		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
+			break;
 		}
+
+		offset += chunkCount;
+	}
+
+	if (NULL != signedCount)
+	{
+		*signedCount = offset;
 	}
 
 	return ret;
@@ -604,12 +1016,7 @@ int getCardNumber(char * buffer, int bufferLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.getCardNumber() failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -629,24 +1036,14 @@ int setLicence(unsigned char * licence, int licenceLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.setLicence() failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	int limit = (*GET_SIGNATURE_LIMIT)();
 	if (limit < 0)
 	{
         fprintf(stdout, "Error: SecSigner.getSignatureLimit() failed. ret=%d\n", limit);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 	else
 	{
@@ -670,12 +1067,7 @@ int getCardName(char * buffer, int bufferLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.getCardName() failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -695,12 +1087,7 @@ int getCardReaderName(char * buffer, int bufferLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.getCardReaderName() failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -721,12 +1108,7 @@ int getCardReaderFirmwareVersion(char * buffer, int bufferLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.getCardReaderFirmwareVersion() failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -746,12 +1128,7 @@ int getVersion(char * buffer, int bufferLen)
 	if (ret < 0)
 	{
         fprintf(stderr, "Error: SecSigner.getVersion failed. ret=%d\n", ret);
-		char errorMsg[5000];
-		errorMsg[0] = 0; // empty string
-		if (0 == (*GET_ERRORMESSAGE)(errorMsg, 5000))
-		{
-			fprintf(stderr, "Message: %s\n", errorMsg);
-		}
+		printErrorMessage();
 	}
 
 	return ret;
@@ -765,7 +1142,7 @@ int main(int argc, char* argv[])
 {
 	if (argc < 6)
 	{
-		printf ("usage TestCallSecSignerDLL <test mode> <CallSecSignerDLL> <SecSignerPropertyName> <SecSignerInstallPath> <maxMemMB> ... \n");
+		printf ("usage TestCallSecSignerDLL <test mode> <CallSecSignerDLL> <SecSignerPropertyName> <SecSignerInstallPath> <maxMemMB> <documentsPath> [<JavaVMOptions> [<useClassDataArchive>]]\n");
 		return 1;
 	}
 
@@ -779,6 +1156,13 @@ int main(int argc, char* argv[])
 	// path of documents to be signed
 	char * documentsPath = NULL;
 
+	// optional additional JavaVM options, e.g. "-Xms512m -XX:+UseG1GC -Xss2m -Dfile.encoding=UTF-8".
+	// The maximum heap size is always set by maxMemMB.
+	char * javaVMOptions = ((argc > 7) && (0 != argv[7][0])) ? argv[7] : NULL;
+
+	// optional '1' = start the JavaVM from the class data sharing archive in the installation path
+	bool useClassDataArchive = (argc > 8) && (argv[8][0] == '1');
+
 	bool signGivenDocs = false;
 	bool verifyGivenDocs = false;
 	bool encryptGivenDocs = false;
@@ -842,6 +1226,48 @@ int main(int argc, char* argv[])
 		return 2;
 	}
 
+	if (NULL != javaVMOptions)
+	{
+		printf("Additional JavaVM options: %s\n", javaVMOptions);
+		if (0 != addJavaToolOption(javaVMOptions))
+		{
+			return 7;
+		}
+	}
+
+	// Use the class data sharing archive of the SecSigner classes if requested. Mapping
+	// the archived classes is faster than loading them from the JARs, so the JavaVM
+	// starts faster. The archive has to be created with the installed Java Runtime,
+	// version 13 or newer. An older JavaVM does not start with this option.
+	if (useClassDataArchive)
+	{
+		char classDataArchive[MAX_PATH];
+		sprintf_s(classDataArchive, MAX_PATH, "%s\\%s", secSignerInstallPath, CLASS_DATA_ARCHIVE_NAME);
+
+		// JAVA_TOOL_OPTIONS is split at white space, so the short name of the path is used
+		char shortClassDataArchive[MAX_PATH];
+		DWORD shortLen = GetShortPathName(classDataArchive, shortClassDataArchive, MAX_PATH);
+		if ((0 == shortLen) || (shortLen >= (DWORD)MAX_PATH))
+		{
+			fprintf(stderr, "Error: class data sharing archive %s not found.\n", classDataArchive);
+			return 7;
+		}
+
+		if (NULL != strpbrk(shortClassDataArchive, " \t"))
+		{
+			fprintf(stderr, "Error: path of class data sharing archive %s contains white space.\n", shortClassDataArchive);
+			return 7;
+		}
+
+		char sharedArchiveOption[MAX_PATH + 30];
+		sprintf_s(sharedArchiveOption, MAX_PATH + 30, "-XX:SharedArchiveFile=%s", shortClassDataArchive);
+		if (0 != addJavaToolOption(sharedArchiveOption))
+		{
+			return 7;
+		}
+		printf("Using class data sharing archive %s\n", classDataArchive);
+	}
+
 	// Load DLL
 	printf("Loading SecSigner DLL %s\n", secSignerDllName);
 	int ret = loadSecSignerDLL(secSignerDllName);
@@ -866,6 +1292,9 @@ int main(int argc, char* argv[])
 		return ret;
 	}
 
+	// set if Ctrl-C has canceled the sign or encrypt-only batches
+	bool canceled = false;
+
 	// init SecSecSigner
 	ret = initSecSigner(secSignerPropertyName, secSignerInstallPath);
 	if (ret <0)
@@ -1094,12 +1523,9 @@ int main(int argc, char* argv[])
 		char * fileNames[DOCCOUNT];
 #define FILE_NAME_WITH_PATH_LEN 200
 		char fileNameWithPath[FILE_NAME_WITH_PATH_LEN];
-		unsigned char * contentBuffer;
-		unsigned char * signatureBuffer;
-		unsigned char * encrSigBuffer;
-		unsigned char * timestampBuffer;
-		size_t filePos;
+		MAPPEDFILE contentFiles[DOCCOUNT]; // to be signed content
 		DOCUMENT documents[DOCCOUNT];
+		BATCHBUFFER resultBuffer = { NULL, 0, 0 }; // returned signatures, encrypted signatures and time stamps
 
 		fileNames[ 0] = "doc1000.txt";
 		fileNames[ 1] = "doc1001.txt";
@@ -1118,102 +1544,53 @@ int main(int argc, char* argv[])
 		fileNames[14] = "doc1014.txt";
 		fileNames[15] = "doc1015.txt";
 
+		BYTEARRAY * cipherCerts = NULL; // no encryption certificates in this example
+		int cipherCertCount = -1;       // do not show encryption certificate dialog
+		BYTEARRAY * signingKeyAndOrCertData = NULL; // no software key in this example
+		int signingKeyAndOrCertDataCount = 0;
+
+		// Ctrl-C cancels before the next batch. The JavaVM has installed its own console
+		// handler, which exits the process. Windows calls the last registered handler
+		// first, so this one runs instead while the batches are processed.
+		SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+
 		// sign twice, just to test the signature call, of course once is enough in production
 		for (int s=0; s<2; s++)
 		{
+			if (isCanceled(&consoleCancelToken))
+			{
+				printf("Signature canceled\n");
+				canceled = true;
+				break;
+			}
+
 			for (int i=0; i<DOCCOUNT; i++)
 			{
 				// set document file name
 				sprintf_s(fileNameWithPath, FILE_NAME_WITH_PATH_LEN, "%s\\%s", documentsPath, fileNames[i]);
 				printf ("Reading %s\n", fileNameWithPath);
 
-				// buffer for to be signed content
-				contentBuffer = (unsigned char*)malloc(CONTENT_BUF_LEN +1); // 1 byte more to notice if the file is too large
-				if (NULL == contentBuffer)
-				{
-					printf("No memory for content buffer\n");
-					return -1;
-				}
-
-				// buffer for returned signature
-				signatureBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-				if (NULL == signatureBuffer)
+				// map test file, SecSigner reads the to be signed content from the mapping
+				if (0 != mapFile(fileNameWithPath, &contentFiles[i]))
 				{
-					printf("No memory for content buffer\n");
-					return -1;
-				}
-
-				// buffer for returned encrypted signature (if encryption certificates are supplied)
-				encrSigBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-				if (NULL == encrSigBuffer)
-				{
-					printf("No memory for encrypted signature buffer\n");
-					return -1;
-				}
-	
-				// buffer for returned time stamp
-				timestampBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-				if (NULL == timestampBuffer)
-				{
-					printf("No memory for time stamp buffer\n");
-					return -1;
-				}
-	
-				// read test file
-				int fd;
-			    int openRet = _sopen_s(&fd, fileNameWithPath, O_RDONLY | O_BINARY, _SH_DENYWR, S_IREAD);
-				if (0 != openRet)
-				{
-					printf("Cannot open test data %s\n", fileNameWithPath);
-					return -1;
-				}
-
-				filePos = 0;
-				while (true)
-				{
-					int bytesRead = _read(fd, &contentBuffer[filePos], CONTENT_BUF_LEN +1 -filePos);
-			
-					if (bytesRead < 0)
-					{
-						printf("Cannot read test data %s\n", fileNameWithPath);
-						return -1;
-					}
-
-					if (bytesRead == 0)
-					{
-						break;
-					}
-	
-					filePos+=bytesRead;
-				}
-			
-				_close(fd);
-				if (filePos > CONTENT_BUF_LEN)
-				{
-					printf("Test data file %s is larger than the buffer of %d bytes.\n", fileNameWithPath, CONTENT_BUF_LEN);
+					printf("Cannot read test data %s\n", fileNameWithPath);
 					return -1;
 				}
 
 				// fill document struct
 				documents[i].version = 13;
 				documents[i].documentFileName = fileNames[i];
-				documents[i].dataToBeSigned = contentBuffer;
-				documents[i].dataToBeSignedLen = filePos;
+				documents[i].dataToBeSigned = contentFiles[i].data;
+				documents[i].dataToBeSignedLen = contentFiles[i].dataLen;
 				documents[i].dataToBeSignedBufLen = 0; // not used in signature mode
 				documents[i].documentType = SIGNDATATYPE_PLAINTEXT;
 				documents[i].signatureFormatType = SIGNATUREFORMATTYPE_PKCS7;
 				documents[i].mimeType = NULL;
 				documents[i].oldSignature = NULL; // a previous signature for the same document could be set here
 				documents[i].oldSignatureLen = 0;
-				documents[i].signature = signatureBuffer;
-				documents[i].signatureLen = SIG_BUF_LEN;
-				documents[i].encryptedSig = encrSigBuffer;
-				documents[i].encryptedSigLen = SIG_BUF_LEN;
 				documents[i].ocspResponse = NULL;
 				documents[i].ocspResponseLen = 0;
 				documents[i].ocspResponseBufLen = 0;
-				documents[i].timeStamp = timestampBuffer;
-				documents[i].timeStampLen = SIG_BUF_LEN;
 				documents[i].encryptedDoc = NULL;
 				documents[i].encryptedDocLen = 0;
 				documents[i].hashAlgorithm = NULL; // NULL = "autoselect", "SHA1", "SHA256", "SHA512", ...
@@ -1266,22 +1643,69 @@ int main(int argc, char* argv[])
                 pdfAnnotation[0].pdfSigBackgroundImage = NULL; // Display reader operated verification item as jpg (max. 220x70 pixel)
                 pdfAnnotation[0].pdfFormFieldName = NULL; // Display reader operated verification item as jpg (max. 220x70 pixel)
                 pdfAnnotation[0].pdfOutlineName = NULL; // The position is given by a form field. The rect entry of form fields dictionary will be used.
+
+				// Lengths of the buffers for the returned signature, encrypted signature and time stamp.
+				// They are estimated from the signature format of this document. SecSigner_Sign()
+				// still returns BUFFER_TOO_SHORT if the signature turns out to be larger.
+				size_t signatureBufLen = getSignatureBufLen(&documents[i]);
+				size_t encryptedSigBufLen = 0; // -1: no encryption, so no encrypted signature
+				if (cipherCertCount >= 0)
+				{
+					encryptedSigBufLen = getEncryptedBufLen(signatureBufLen, cipherCertCount);
+				}
+				if ((signatureBufLen > INT_MAX) || (encryptedSigBufLen > INT_MAX)) // the lengths in DOCUMENT are int
+				{
+					printf("%s is too large for the signature buffers.\n", fileNameWithPath);
+					return -1;
+				}
+				documents[i].signatureLen = (int)signatureBufLen;
+				documents[i].encryptedSigLen = (int)encryptedSigBufLen;
+				documents[i].timeStampLen = TIMESTAMP_BUF_LEN;
+			}
+
+			// take the result buffers of all documents from one batch buffer
+			size_t resultBufferLen = 0;
+			for (int i=0; i<DOCCOUNT; i++)
+			{
+				resultBufferLen += (size_t)documents[i].signatureLen + (size_t)documents[i].encryptedSigLen + (size_t)documents[i].timeStampLen;
+			}
+
+			if (OK != reserveBatchBuffer(&resultBuffer, resultBufferLen))
+			{
+				printf("No memory for result buffers\n");
+				return -1;
 			}
 
-			BYTEARRAY * cipherCerts = NULL; // no encryption certificates in this example
-			int cipherCertCount = -1;       // do not show encryption certificate dialog
-			BYTEARRAY * signingKeyAndOrCertData = NULL; // no software key in this example
-			int signingKeyAndOrCertDataCount = 0;
+			for (int i=0; i<DOCCOUNT; i++)
+			{
+				documents[i].signature = takeFromBatchBuffer(&resultBuffer, documents[i].signatureLen);
+				documents[i].encryptedSig = takeFromBatchBuffer(&resultBuffer, documents[i].encryptedSigLen);
+				documents[i].timeStamp = takeFromBatchBuffer(&resultBuffer, documents[i].timeStampLen);
+			}
 
 			// call Signer signature process
 			printf ("Calling SecSigner signature\n");
-			ret = signDocs(documents, DOCCOUNT, cipherCerts, cipherCertCount, signingKeyAndOrCertData, signingKeyAndOrCertDataCount);
+			int signedCount = 0;
+			LONGLONG signStartTime = getNanoTime();
+			ret = signDocsInChunks(documents, DOCCOUNT, cipherCerts, cipherCertCount,
+				signingKeyAndOrCertData, signingKeyAndOrCertDataCount, &consoleCancelToken, &signedCount);
+			LONGLONG elapsedNanos = getNanoTime() - signStartTime;
 			printf("signature return value =%d\n", ret);
+			if (signedCount > 0)
+			{
+				// only the documents actually signed, a failed or canceled chunk signed none
+				printCallDuration("Signature", signedCount, elapsedNanos);
+			}
+			if (CANCELED == ret)
+			{
+				canceled = true;
+			}
 
-			if (ret == OK)
+			if (signedCount > 0)
 			{
-				// write the returned signatures to files
-				for (int j=0; j<DOCCOUNT; j++)
+				// write the returned signatures to files, including those of the chunks
+				// finished before an error or cancellation
+				for (int j=0; j<signedCount; j++)
 				{
 					sprintf_s(fileNameWithPath, FILE_NAME_WITH_PATH_LEN, "%s\\%s.pkcs7", documentsPath, fileNames[j]);
 	
@@ -1322,17 +1746,8 @@ int main(int argc, char* argv[])
 			for (int d=0; d<DOCCOUNT; d++)
 			{
 				// release the buffers
-				if (documents[d].dataToBeSigned != NULL)
-				{
-					free (documents[d].dataToBeSigned);
-					documents[d].dataToBeSigned = NULL;
-				}
-
-				if (documents[d].signature != NULL)
-				{
-					free (documents[d].signature);
-					documents[d].signature = NULL;
-				}
+				unmapFile(&contentFiles[d]);
+				documents[d].dataToBeSigned = NULL;
 
 				if (documents[d].oldSignature != NULL)
 				{
@@ -1340,19 +1755,15 @@ int main(int argc, char* argv[])
 					documents[d].oldSignature = NULL;
 				}
 
-				if (documents[d].encryptedSig != NULL)
-				{
-					free (documents[d].encryptedSig);
-					documents[d].encryptedSig = NULL;
-				}
-
-				if (documents[d].timeStamp != NULL)
-				{
-					free (documents[d].timeStamp);
-					documents[d].timeStamp = NULL;
-				}
+				// the result buffers belong to the batch buffer
+				documents[d].signature = NULL;
+				documents[d].encryptedSig = NULL;
+				documents[d].timeStamp = NULL;
 			}
 		}
+
+		SetConsoleCtrlHandler(consoleCtrlHandler, FALSE);
+		freeBatchBuffer(&resultBuffer);
 	}
 	else if (verifyGivenDocs)
 	{
@@ -1366,7 +1777,6 @@ int main(int argc, char* argv[])
 		char evidenceRec1FileNameWithPath[FILE_NAME_WITH_PATH_LEN];
 		char evidenceRec2FileNameWithPath[FILE_NAME_WITH_PATH_LEN];
 	
-		unsigned char * contentBuffer;
 		unsigned char * signatureBuffer;
 		unsigned char * sigAfterVerifyBuffer;
 		unsigned char * timestampBuffer;
@@ -1375,7 +1785,9 @@ int main(int argc, char* argv[])
 
 		size_t filePos;
 		const int DOC_COUNT = 10;
+		MAPPEDFILE contentFiles[DOC_COUNT]; // signed content
 		DOCUMENT documents[DOC_COUNT];
+		BATCHBUFFER resultBuffer = { NULL, 0, 0 }; // returned OCSP responses and new signatures
 		int dmsDocIDInt = 500;
 	
 		fileNames[ 0] = "document_01.pdf";
@@ -1388,17 +1800,16 @@ int main(int argc, char* argv[])
 		fileNames[ 7] = "document_08.pdf";
 		fileNames[ 8] = "document_09.pdf";
 		fileNames[ 9] = "document_10.pdf";
+
+		// the OCSP response and new signature buffers of all documents are taken from one batch buffer
+		if (OK != reserveBatchBuffer(&resultBuffer, DOC_COUNT * 2 * SIG_BUF_LEN))
+		{
+			printf("No memory for result buffers\n");
+			return -1;
+		}
 		
 		for (int vi=0; vi<DOC_COUNT; vi++)
 		{
-			// buffer for signed content
-			contentBuffer = (unsigned char*)malloc(CONTENT_BUF_LEN);
-			if (NULL == contentBuffer)
-			{
-				printf("No memory for content buffer\n");
-				return -1;
-			}
-
 			// buffer for signature
 			signatureBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
 			if (NULL == signatureBuffer)
@@ -1408,20 +1819,10 @@ int main(int argc, char* argv[])
 			}
 
 			// buffer for new signature, done by the verifier (optional)
-			sigAfterVerifyBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-			if (NULL == sigAfterVerifyBuffer)
-			{
-				printf("No memory for a buffer for the optional new signature of the verifier\n");
-				return -1;
-			}
+			sigAfterVerifyBuffer = takeFromBatchBuffer(&resultBuffer, SIG_BUF_LEN);
 
 			// buffer for supplied or returned OCSP response
-			ocspResponseBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-			if (NULL == ocspResponseBuffer)
-			{
-				printf("No memory for OCSP response buffer\n");
-				return -1;
-			}
+			ocspResponseBuffer = takeFromBatchBuffer(&resultBuffer, SIG_BUF_LEN);
 	
 			// buffer for first supplied evidence record. This example uses 2 evidence records.
 			evidenceRecordArray[0].data = (unsigned char*)malloc(ERS_BUF_LEN);
@@ -1455,44 +1856,22 @@ int main(int argc, char* argv[])
 			sprintf_s(evidenceRec1FileNameWithPath, FILE_NAME_WITH_PATH_LEN, "%s\\%s-1.ers", documentsPath, fileNames[vi]);
 			sprintf_s(evidenceRec2FileNameWithPath, FILE_NAME_WITH_PATH_LEN, "%s\\%s-2.ers", documentsPath, fileNames[vi]);
 
-			// read document
+			// map document, SecSigner reads the signed content from the mapping
 			printf ("Reading %s\n", docFileNameWithPath);
-			int fd;
-			int openRet = _sopen_s(&fd, docFileNameWithPath, O_RDONLY | O_BINARY, _SH_DENYWR, S_IREAD);
-			if (0 != openRet)
+			if (0 != mapFile(docFileNameWithPath, &contentFiles[vi]))
 			{
-				printf("Cannot open document %s\n", docFileNameWithPath);
+				printf("Cannot read document %s\n", docFileNameWithPath);
 				return -1;
 			}
 
-			filePos = 0;
-			while (true)
-			{
-				int bytesRead = _read(fd, &contentBuffer[filePos], CONTENT_BUF_LEN-filePos);
-			
-				if (bytesRead < 0)
-				{
-					printf("Cannot read document %s\n", fileNameWithPath);
-					return -1;
-				}
-
-				if (bytesRead == 0)
-				{
-					break;
-				}
-
-				filePos+=bytesRead;
-			}
-			
-			_close(fd);
-
-			documents[vi].dataToBeSigned = contentBuffer;
-			documents[vi].dataToBeSignedLen = filePos;
+			documents[vi].dataToBeSigned = contentFiles[vi].data;
+			documents[vi].dataToBeSignedLen = contentFiles[vi].dataLen;
 			documents[vi].dataToBeSignedBufLen = 0; // signed content shall not be returned
 
 			// read signature
 			printf ("Reading %s\n", sigFileNameWithPath);
-			openRet = _sopen_s(&fd, sigFileNameWithPath, O_RDONLY | O_BINARY, _SH_DENYWR, S_IREAD);
+			int fd;
+			int openRet = _sopen_s(&fd, sigFileNameWithPath, O_RDONLY | O_BINARY, _SH_DENYWR, S_IREAD);
 			if (0 != openRet)
 			{
 				printf("Cannot open signature %s\n", sigFileNameWithPath);
@@ -1705,11 +2084,15 @@ int main(int argc, char* argv[])
 
 		// call SecSigner verification process
 		printf ("Calling SecSigner verification\n");
+		LONGLONG verifyStartTime = getNanoTime();
 		ret = verifyDocs(documents, DOC_COUNT);
+		LONGLONG verifyNanos = getNanoTime() - verifyStartTime;
 		printf("verification return value =%d\n", ret);
 
 		if (ret == OK)
 		{
+			printCallDuration("Verification", DOC_COUNT, verifyNanos);
+
 			for (int j=0; j<DOC_COUNT; j++)
 			{
 				// write the returned OCSP responses to files
@@ -1766,11 +2149,8 @@ int main(int argc, char* argv[])
 		for (int d=0; d<DOC_COUNT; d++)
 		{
 			// release the buffers
-			if (documents[d].dataToBeSigned != NULL)
-			{
-				free (documents[d].dataToBeSigned);
-				documents[d].dataToBeSigned = NULL;
-			}
+			unmapFile(&contentFiles[d]);
+			documents[d].dataToBeSigned = NULL;
 
 			if (documents[d].signature != NULL)
 			{
@@ -1778,18 +2158,6 @@ int main(int argc, char* argv[])
 				documents[d].signature = NULL;
 			}
 
-			if (documents[d].oldSignature != NULL)
-			{
-				free (documents[d].oldSignature);
-				documents[d].oldSignature = NULL;
-			}
-
-			if (documents[d].ocspResponse != NULL)
-			{
-				free (documents[d].ocspResponse);
-				documents[d].ocspResponse = NULL;
-			}
-
 			if (documents[d].encryptedSig != NULL)
 			{
 				free (documents[d].encryptedSig);
@@ -1801,7 +2169,13 @@ int main(int argc, char* argv[])
 				free (documents[d].timeStamp);
 				documents[d].timeStamp = NULL;
 			}
+
+			// the result buffers belong to the batch buffer
+			documents[d].oldSignature = NULL;
+			documents[d].ocspResponse = NULL;
 		}
+
+		freeBatchBuffer(&resultBuffer);
 	}
 	else if (encryptGivenDocs)
 	{
@@ -1811,12 +2185,12 @@ int main(int argc, char* argv[])
 		char * fileNames[DOCCOUNT];
 		char * certFileNames[CIPHERCERTCOUNT];
 		char fileNameWithPath[FILE_NAME_WITH_PATH_LEN];
-		unsigned char * contentBuffer;
+		MAPPEDFILE contentFiles[DOCCOUNT]; // to be encrypted content
 		unsigned char * certBuffer;
-		unsigned char * encrDocBuffer;
 		size_t filePos;
 		DOCUMENT documents[DOCCOUNT];
 		BYTEARRAY cipherCerts[CIPHERCERTCOUNT];
+		BATCHBUFFER resultBuffer = { NULL, 0, 0 }; // returned encrypted documents
 
 		fileNames[ 0] = "doc1000.txt";
 		fileNames[ 1] = "doc1001.txt";
@@ -1838,66 +2212,37 @@ int main(int argc, char* argv[])
 		certFileNames[0] = "encrCert1.der";
 		certFileNames[1] = "encrCert2.der";
 
+		// Ctrl-C cancels before the next batch, as with the signature batches
+		SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+
 		// encrypt twice, just to test the encryption call, of course once is enough in production
 		for (int s=0; s<2; s++)
 		{
+			if (isCanceled(&consoleCancelToken))
+			{
+				printf("Encryption canceled\n");
+				canceled = true;
+				break;
+			}
+
 			for (int i=0; i<DOCCOUNT; i++)
 			{
 				// set document file name
 				sprintf_s(fileNameWithPath, FILE_NAME_WITH_PATH_LEN, "%s\\%s", documentsPath, fileNames[i]);
 				printf ("Reading %s\n", fileNameWithPath);
 
-				// buffer for to be signed content
-				contentBuffer = (unsigned char*)malloc(CONTENT_BUF_LEN);
-				if (NULL == contentBuffer)
-				{
-					printf("No memory for content buffer\n");
-					return -1;
-				}
-
-				// buffer for returned encrypted document
-				encrDocBuffer = (unsigned char*)malloc(SIG_BUF_LEN);
-				if (NULL == encrDocBuffer)
-				{
-					printf("No memory for encrypted document buffer\n");
-					return -1;
-				}
-	
-				// read test file
-				int fd;
-				int openRet = _sopen_s(&fd, fileNameWithPath, O_RDONLY | O_BINARY, _SH_DENYWR, S_IREAD);
-				if (0 != openRet)
+				// map test file, SecSigner reads the to be encrypted content from the mapping
+				if (0 != mapFile(fileNameWithPath, &contentFiles[i]))
 				{
-					printf("Cannot open test data %s\n", fileNameWithPath);
+					printf("Cannot read test data %s\n", fileNameWithPath);
 					return -1;
 				}
 
-				filePos = 0;
-				while (true)
-				{
-					int bytesRead = _read(fd, &contentBuffer[filePos], CONTENT_BUF_LEN-filePos);
-			
-					if (bytesRead < 0)
-					{
-						printf("Cannot read test data %s\n", fileNameWithPath);
-						return -1;
-					}
-
-					if (bytesRead == 0)
-					{
-						break;
-					}
-	
-					filePos+=bytesRead;
-				}
-			
-				_close(fd);
-
 				// fill document struct
 				documents[i].version = 13;
 				documents[i].documentFileName = fileNames[i]; // not used in encryption mode
-				documents[i].dataToBeSigned = contentBuffer;
-				documents[i].dataToBeSignedLen = filePos;
+				documents[i].dataToBeSigned = contentFiles[i].data;
+				documents[i].dataToBeSignedLen = contentFiles[i].dataLen;
 				documents[i].dataToBeSignedBufLen = 0; // not used in encryption mode
 				documents[i].documentType = SIGNDATATYPE_PLAINTEXT; // not used in encryption mode
   				documents[i].signatureFormatType = NULL; // not used in encryption mode
@@ -1923,12 +2268,35 @@ int main(int argc, char* argv[])
 				documents[i].numberOfXmlDSigFilterPaths = 0; // not used in encryption mode
 				documents[i].xmlDSigNameSpaceName = NULL;   // not used in encryption mode
 				documents[i].pdfAnnotation = NULL; // not used in encryption mode
-				documents[i].encryptedDoc = encrDocBuffer;
-				documents[i].encryptedDocLen = SIG_BUF_LEN;
+				size_t encryptedDocBufLen = getEncryptedBufLen((size_t)contentFiles[i].dataLen, CIPHERCERTCOUNT);
+				if (encryptedDocBufLen > INT_MAX) // the lengths in DOCUMENT are int
+				{
+					printf("%s is too large for the encryption buffer.\n", fileNameWithPath);
+					return -1;
+				}
+				documents[i].encryptedDocLen = (int)encryptedDocBufLen; // estimated for the document and all recipients
 				documents[i].verificationReport = NULL; // dont need the verification report
 				documents[i].verificationReportLen = 0;
 			}
 
+			// take the buffers for the returned encrypted documents from one batch buffer
+			size_t resultBufferLen = 0;
+			for (int i=0; i<DOCCOUNT; i++)
+			{
+				resultBufferLen += (size_t)documents[i].encryptedDocLen;
+			}
+
+			if (OK != reserveBatchBuffer(&resultBuffer, resultBufferLen))
+			{
+				printf("No memory for result buffers\n");
+				return -1;
+			}
+
+			for (int i=0; i<DOCCOUNT; i++)
+			{
+				documents[i].encryptedDoc = takeFromBatchBuffer(&resultBuffer, documents[i].encryptedDocLen);
+			}
+
 			for (int i=0; i<CIPHERCERTCOUNT; i++)
 			{
 				// set document file name
@@ -1980,11 +2348,15 @@ int main(int argc, char* argv[])
 
 			// call Signer encryption process
 			printf ("Calling SecSigner encryption\n");
+			LONGLONG encryptStartTime = getNanoTime();
 			ret = encryptDocs(documents, DOCCOUNT, cipherCerts, CIPHERCERTCOUNT);
+			LONGLONG encryptNanos = getNanoTime() - encryptStartTime;
 			printf("encryption return value =%d\n", ret);
 
 			if (ret == OK)
 			{
+				printCallDuration("Encryption", DOCCOUNT, encryptNanos);
+
 				// write the returned encrypted documents to files
 				for (int j=0; j<DOCCOUNT; j++)
 				{
@@ -2010,17 +2382,11 @@ int main(int argc, char* argv[])
 			for (int d=0; d<DOCCOUNT; d++)
 			{
 				// release the buffers
-				if (documents[d].dataToBeSigned != NULL)
-				{
-					free (documents[d].dataToBeSigned);
-					documents[d].dataToBeSigned = NULL;
-				}
+				unmapFile(&contentFiles[d]);
+				documents[d].dataToBeSigned = NULL;
 
-				if (documents[d].encryptedDoc != NULL)
-				{
-					free (documents[d].encryptedDoc);
-					documents[d].encryptedDoc = NULL;
-				}
+				// the result buffer belongs to the batch buffer
+				documents[d].encryptedDoc = NULL;
 			}
 
 			for (int i=0; i<CIPHERCERTCOUNT; i++)
@@ -2030,6 +2396,9 @@ int main(int argc, char* argv[])
 				cipherCerts[i].data = NULL;
 			}
 		}
+
+		SetConsoleCtrlHandler(consoleCtrlHandler, FALSE);
+		freeBatchBuffer(&resultBuffer);
 	}
 
 
@@ -2071,5 +2440,5 @@ int main(int argc, char* argv[])
     FreeLibrary(hSecSignerDLL);
 
 	printf ("SecCommerce SecSigner test program ends.\n");
-	return ret;
+	return canceled ? CANCELED : ret;
 }